@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Buffered writer for bulk output such as package listings. Text is collected
+// in a reusable buffer and handed to the stream in large chunks, and color
+// codes are dropped when the stream is not a terminal.
+class Output {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    explicit Output(FILE* stream);
+    ~Output();
+
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+
+    Output& write(std::string_view text);
+    Output& write(char c);
+    Output& color(std::string_view code);
+    Output& reset();
+    Output& json_string(std::string_view text);
+    Output& tsv_field(std::string_view text);
+    void flush();
+
+private:
+    void reserve(size_t extra);
+
+    FILE* stream;
+    bool tty;
+    std::string buffer;
+};
@@ -2,35 +2,70 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+struct ListOptions {
+    enum class Format { Text, Json, Tsv };
+    enum class Filter { All, Installed, Upgradable, Available };
+    
+    Format format = Format::Text;
+    Filter filter = Filter::All;
+    std::vector<std::string> columns;
+};
+
 class PackageManager {
 public:
     static constexpr const char* VERSION = "1.1";
     
     PackageManager();
     
+    static bool parse_list_options(const std::vector<std::string>& args, ListOptions& options, std::string& error);
+    
     bool update();
     bool install(const std::string& package_name);
     bool remove(const std::string& package_name);
     bool upgrade(const std::string& package_name);
-    bool list();
+    bool list(const ListOptions& options = ListOptions());
     bool interactive_mode();
     bool debug();
     void version();
     void updateYns();
+    bool mirror(const std::string& dir);
     
 private:
+    struct Repository {
+        std::string name;
+        std::string url;
+        int priority = 0;
+        std::vector<std::string> pins;
+    };
+    
     static constexpr const char* REPO_URL = "https://raw.githubusercontent.com/spitkov/ynsrepo/refs/heads/main/repo.json";
     static constexpr const char* CACHE_DIR = "/var/cache/yns/";
     static constexpr const char* CACHE_FILE = "/var/cache/yns/repo.json";
+    static constexpr const char* REPOS_CACHE_DIR = "/var/cache/yns/repos/";
+    static constexpr const char* REPOS_CONFIG = "/etc/yns/repos.json";
     static constexpr const char* INSTALLED_DB = "/var/lib/yns/installed.json";
+    static constexpr const char* MIRROR_MANIFEST = ".yns-mirror.json";
+    static constexpr int MIRROR_JOBS = 8;
     
+    std::string repo_url();
+    std::string resolve_url(const std::string& base, const std::string& ref);
+    bool fetch_url(const std::string& url, std::string& data);
+    bool fetch_url(const std::string& url, std::string& data, json& validators, bool& modified);
+    bool read_mapped_file(const std::string& path, std::string& data);
+    bool write_file_atomic(const std::string& path, const std::string& data);
     bool download_file(const std::string& url, const std::string& output_path);
     bool execute_script(const std::string& script_path);
     bool cache_repo();
+    void load_repositories();
+    bool fetch_repository(const Repository& repo, bool& changed);
+    std::string repo_cache_path(const Repository& repo, const std::string& file);
+    bool merge_repositories(const std::vector<Repository>& repos, const std::vector<bool>& changed);
+    std::string script_url(const json& package, const std::string& key);
     json read_cache();
     json read_installed_db();
     void save_installed_db(const json& db);
@@ -40,6 +75,10 @@ private:
     void print_interactive_help();
     bool confirm_action(const std::string& action);
     
+    std::vector<Repository> repositories;
+    std::string repositories_source;
+    bool repositories_loaded = false;
     json repo_cache;
     json installed_packages;
+    bool quiet = false;
 }; 
\ No newline at end of file
@@ -11,11 +11,19 @@ void print_usage() {
               << "  install <package>   Install a package\n"
               << "  remove <package>    Remove a package\n"
               << "  upgrade <package>   Upgrade a package\n"
-              << "  list               List all packages\n"
+              << "  list [options]     List packages\n"
               << "  debug              Show debug information\n"
               << "  interactive        Start interactive mode\n"
               << "  version            Show YNS version\n"
-              << "  updateyns          Update YNS to latest version\n\n"
+              << "  updateyns          Update YNS to latest version\n"
+              << "  mirror <dir>       Sync repository and scripts into <dir>\n\n"
+              << "List options:\n"
+              << "  --installed        Only show installed packages\n"
+              << "  --upgradable       Only show packages with an update available\n"
+              << "  --available        Only show packages that are not installed\n"
+              << "  --json, --tsv      Machine-readable output\n"
+              << "  --columns=a,b      Columns for --json/--tsv: name, version, installed,\n"
+              << "                     status, repository, description\n\n"
               << "Interactive Mode:\n"
               << "  Run 'yns interactive' to enter interactive mode where you can\n"
               << "  execute multiple commands without prefix. Type 'help' in\n"
@@ -26,7 +34,8 @@ bool needs_sudo(const std::string& command) {
     return command == "update" || command == "install" || 
            command == "remove" || command == "upgrade" || 
            command == "interactive" || command == "list" ||
-           command == "debug" || command == "version" || command == "updateyns";
+           command == "debug" || command == "version" || command == "updateyns" ||
+           command == "mirror";
 }
 
 std::string get_self_path() {
@@ -55,7 +64,13 @@ int main(int argc, char* argv[]) {
         } else if (command == "upgrade" && argc == 3) {
             pm.upgrade(argv[2]);
         } else if (command == "list") {
-            pm.list();
+            ListOptions options;
+            std::string error;
+            if (!PackageManager::parse_list_options(std::vector<std::string>(argv + 2, argv + argc), options, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+            pm.list(options);
         } else if (command == "debug") {
             pm.debug();
         } else if (command == "interactive") {
@@ -64,6 +79,8 @@ int main(int argc, char* argv[]) {
             pm.version();
         } else if (command == "updateyns") {
             pm.updateYns();
+        } else if (command == "mirror" && argc == 3) {
+            pm.mirror(argv[2]);
         } else {
             std::cerr << "Error: Unknown command '" << command << "'" << std::endl;
             std::cout << "Usage: yns <command> [package_name]" << std::endl;
@@ -72,11 +89,12 @@ int main(int argc, char* argv[]) {
             std::cout << "  install <package>   Install a package\n";
             std::cout << "  remove <package>    Remove a package\n";
             std::cout << "  upgrade <package>   Upgrade a package\n";
-            std::cout << "  list               List all packages\n";
+            std::cout << "  list [options]     List packages\n";
             std::cout << "  debug              Show debug information\n";
             std::cout << "  interactive        Start interactive mode\n";
             std::cout << "  version            Show YNS version\n";
             std::cout << "  updateyns          Update YNS to latest version\n";
+            std::cout << "  mirror <dir>       Sync repository and scripts into <dir>\n";
             return 1;
         }
     } catch (const std::exception& e) {
@@ -0,0 +1,79 @@
+#include "output.hpp"
+#include <unistd.h>
+
+static const char* const COLOR_RESET = "\033[0m";
+
+Output::Output(FILE* stream) : stream(stream), tty(isatty(fileno(stream))) {
+    buffer.reserve(BUFFER_SIZE);
+}
+
+Output::~Output() {
+    flush();
+}
+
+void Output::reserve(size_t extra) {
+    if (buffer.size() + extra > BUFFER_SIZE) flush();
+}
+
+Output& Output::write(std::string_view text) {
+    reserve(text.size());
+    if (text.size() >= BUFFER_SIZE) {
+        fwrite(text.data(), 1, text.size(), stream);
+        return *this;
+    }
+    buffer.append(text);
+    return *this;
+}
+
+Output& Output::write(char c) {
+    reserve(1);
+    buffer.push_back(c);
+    return *this;
+}
+
+Output& Output::color(std::string_view code) {
+    if (tty) write(code);
+    return *this;
+}
+
+Output& Output::reset() {
+    return color(COLOR_RESET);
+}
+
+Output& Output::json_string(std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    write('"');
+    for (char c : text) {
+        switch (c) {
+            case '"': write("\\\""); break;
+            case '\\': write("\\\\"); break;
+            case '\n': write("\\n"); break;
+            case '\r': write("\\r"); break;
+            case '\t': write("\\t"); break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    write("\\u00");
+                    write(hex[(c >> 4) & 0x0f]);
+                    write(hex[c & 0x0f]);
+                } else {
+                    write(c);
+                }
+        }
+    }
+    return write('"');
+}
+
+Output& Output::tsv_field(std::string_view text) {
+    for (char c : text) {
+        write(c == '\t' || c == '\n' || c == '\r' ? ' ' : c);
+    }
+    return *this;
+}
+
+void Output::flush() {
+    if (!buffer.empty()) {
+        fwrite(buffer.data(), 1, buffer.size(), stream);
+        buffer.clear();
+    }
+    fflush(stream);
+}
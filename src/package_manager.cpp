@@ -1,11 +1,25 @@
 #include "package_manager.hpp"
+#include "output.hpp"
 #include <curl/curl.h>
+#include <openssl/sha.h>
 #include <fstream>
 #include <iostream>
 #include <filesystem>
 #include <cstdlib>
+#include <cstdio>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
@@ -20,36 +34,240 @@ static size_t writeCallback(void* contents, size_t size, size_t nmemb, void* use
     return size * nmemb;
 }
 
+static size_t headerCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    auto* headers = static_cast<std::map<std::string, std::string>*>(userp);
+    std::string line(buffer, size * nitems);
+    
+    // A new status line means a redirect; only keep the final response's headers.
+    if (line.rfind("HTTP/", 0) == 0) {
+        headers->clear();
+        return size * nitems;
+    }
+    
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) return size * nitems;
+    
+    std::string name = line.substr(0, colon);
+    for (auto& c : name) c = std::tolower(static_cast<unsigned char>(c));
+    size_t start = line.find_first_not_of(" \t", colon + 1);
+    size_t end = line.find_last_not_of(" \t\r\n");
+    if (start != std::string::npos && end != std::string::npos && end >= start) {
+        (*headers)[name] = line.substr(start, end - start + 1);
+    }
+    return size * nitems;
+}
+
+static std::mutex output_mutex;
+static const bool stdout_tty = isatty(STDOUT_FILENO);
+static const bool stderr_tty = isatty(STDERR_FILENO);
+
+static const std::string& tty_color(const std::string& code) {
+    static const std::string none;
+    return stdout_tty ? code : none;
+}
+
+static std::string sha256_hex(const std::string& data) {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), digest);
+    
+    static const char hex[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(SHA256_DIGEST_LENGTH * 2);
+    for (unsigned char byte : digest) {
+        result += hex[byte >> 4];
+        result += hex[byte & 0x0f];
+    }
+    return result;
+}
+
 PackageManager::PackageManager() {
     fs::create_directories(CACHE_DIR);
+    fs::create_directories(REPOS_CACHE_DIR);
     fs::create_directories("/var/lib/yns");
     curl_global_init(CURL_GLOBAL_DEFAULT);
     installed_packages = read_installed_db();
 }
 
-bool PackageManager::download_file(const std::string& url, const std::string& output_path) {
+std::string PackageManager::repo_url() {
+    const char* override_url = std::getenv("YNS_REPO_URL");
+    if (override_url && *override_url) return override_url;
+    return REPO_URL;
+}
+
+std::string PackageManager::resolve_url(const std::string& base, const std::string& ref) {
+    if (ref.find("://") != std::string::npos) return ref;
+    
+    if (!ref.empty() && ref[0] == '/') {
+        size_t scheme_end = base.find("://");
+        if (scheme_end == std::string::npos) return ref;
+        if (ref.rfind("//", 0) == 0) return base.substr(0, scheme_end + 1) + ref;
+        if (base.rfind("file://", 0) == 0) return "file://" + ref;
+        
+        size_t authority_end = base.find('/', scheme_end + 3);
+        return base.substr(0, authority_end) + ref;
+    }
+    
+    size_t slash = base.rfind('/');
+    if (slash == std::string::npos) return ref;
+    return base.substr(0, slash + 1) + ref;
+}
+
+bool PackageManager::read_mapped_file(const std::string& path, std::string& data) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        print_error("Failed to open " + path);
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        print_error("Failed to stat " + path);
+        return false;
+    }
+    
+    data.clear();
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        print_error("Failed to map " + path);
+        return false;
+    }
+    
+    madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+    data.assign(static_cast<const char*>(mapped), st.st_size);
+    munmap(mapped, st.st_size);
+    return true;
+}
+
+bool PackageManager::fetch_url(const std::string& url, std::string& data) {
+    json validators = json::object();
+    bool modified = true;
+    return fetch_url(url, data, validators, modified);
+}
+
+bool PackageManager::fetch_url(const std::string& url, std::string& data, json& validators, bool& modified) {
+    modified = true;
+    
+    if (url.rfind("file://", 0) == 0) {
+        std::string path = url.substr(7);
+        if (path.rfind("localhost/", 0) == 0) path = path.substr(9);
+        
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            print_error("Failed to stat " + path);
+            return false;
+        }
+        
+        int64_t mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        if (validators.value("mtime", int64_t(-1)) == mtime &&
+            validators.value("size", int64_t(-1)) == static_cast<int64_t>(st.st_size)) {
+            modified = false;
+            data.clear();
+            return true;
+        }
+        
+        if (!read_mapped_file(path, data)) return false;
+        validators = {
+            {"mtime", mtime},
+            {"size", static_cast<int64_t>(st.st_size)}
+        };
+        return true;
+    }
+    
     CURL* curl = curl_easy_init();
     if (!curl) {
         print_error("Failed to initialize CURL");
         return false;
     }
     
-    std::string response_data;
+    struct curl_slist* request_headers = nullptr;
+    if (validators.contains("etag")) {
+        request_headers = curl_slist_append(request_headers,
+            ("If-None-Match: " + validators["etag"].get<std::string>()).c_str());
+    }
+    if (validators.contains("last_modified")) {
+        request_headers = curl_slist_append(request_headers,
+            ("If-Modified-Since: " + validators["last_modified"].get<std::string>()).c_str());
+    }
+    
+    std::map<std::string, std::string> response_headers;
+    data.clear();
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &data);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response_headers);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, request_headers);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     
     char error_buffer[CURL_ERROR_SIZE];
+    error_buffer[0] = '\0';
     curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, error_buffer);
     
     CURLcode res = curl_easy_perform(curl);
+    long response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
     curl_easy_cleanup(curl);
+    curl_slist_free_all(request_headers);
     
     if (res != CURLE_OK) {
-        print_error("Failed to download: " + std::string(error_buffer));
+        print_error("Failed to download: " + std::string(error_buffer[0] ? error_buffer : curl_easy_strerror(res)));
+        return false;
+    }
+    
+    if (response_code == 304) {
+        modified = false;
+        data.clear();
+        return true;
+    }
+    
+    if (response_code >= 400) {
+        print_error("Failed to download " + url + ": HTTP " + std::to_string(response_code));
+        return false;
+    }
+    
+    validators = json::object();
+    if (response_headers.count("etag")) validators["etag"] = response_headers["etag"];
+    if (response_headers.count("last-modified")) validators["last_modified"] = response_headers["last-modified"];
+    return true;
+}
+
+bool PackageManager::write_file_atomic(const std::string& path, const std::string& data) {
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream output_file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!output_file) {
+            print_error("Failed to open file for writing: " + temp_path);
+            return false;
+        }
+        output_file.write(data.data(), data.size());
+        if (!output_file) {
+            print_error("Failed to write file: " + temp_path);
+            return false;
+        }
+    }
+    
+    std::error_code ec;
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        print_error("Failed to replace " + path + ": " + ec.message());
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool PackageManager::download_file(const std::string& url, const std::string& output_path) {
+    std::string response_data;
+    if (!fetch_url(url, response_data)) {
         return false;
     }
     
@@ -79,27 +297,333 @@ bool PackageManager::execute_script(const std::string& script_path) {
     return false;
 }
 
-bool PackageManager::cache_repo() {
-    print_progress("Updating package cache", 0);
+void PackageManager::load_repositories() {
+    if (repositories_loaded) return;
+    repositories_loaded = true;
+    
+    std::vector<Repository>& repos = repositories;
+    repos.clear();
+    
+    // YNS_REPO_URL replaces the configured repositories entirely, which makes
+    // it easy to point a single run at a mirror.
+    const char* override_url = std::getenv("YNS_REPO_URL");
+    if (override_url && *override_url) {
+        Repository repo;
+        repo.name = "main";
+        repo.url = override_url;
+        repos.push_back(repo);
+        repositories_source = "YNS_REPO_URL";
+        return;
+    }
+    
+    repositories_source = REPOS_CONFIG;
+    json config;
+    {
+        std::ifstream config_file(REPOS_CONFIG);
+        if (config_file) {
+            try {
+                config = json::parse(config_file);
+            } catch (const std::exception& e) {
+                print_error("Failed to parse " + std::string(REPOS_CONFIG) + ": " + e.what());
+                return;
+            }
+            if (!config.is_object() || (config.contains("repositories") && !config["repositories"].is_array())) {
+                print_error(std::string(REPOS_CONFIG) + ": 'repositories' must be an array");
+                return;
+            }
+        }
+    }
+    
+    json entries = config.is_object() ? config.value("repositories", json::array()) : json::array();
+    if (entries.empty()) {
+        Repository repo;
+        repo.name = "main";
+        repo.url = REPO_URL;
+        repos.push_back(repo);
+        repositories_source = "built-in default";
+        return;
+    }
+    
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const json& entry = entries[i];
+        std::string label = "repository entry " + std::to_string(i + 1);
+        if (entry.is_object() && entry.contains("name") && entry["name"].is_string()) {
+            label += " ('" + entry["name"].get<std::string>() + "')";
+        }
+        
+        std::string problem;
+        if (!entry.is_object()) {
+            problem = "entry must be an object";
+        } else if (!entry.contains("name") || !entry["name"].is_string()) {
+            problem = "'name' must be a string";
+        } else if (!entry.contains("url") || !entry["url"].is_string() || entry["url"].get<std::string>().empty()) {
+            problem = "'url' must be a non-empty string";
+        } else if (entry.contains("priority") && !entry["priority"].is_number_integer()) {
+            problem = "'priority' must be an integer";
+        } else if (entry.contains("pin") && !entry["pin"].is_array()) {
+            problem = "'pin' must be an array of package names";
+        } else if (entry.contains("pin")) {
+            for (const auto& pin : entry["pin"]) {
+                if (!pin.is_string()) problem = "'pin' must be an array of package names";
+            }
+        }
+        
+        if (problem.empty()) {
+            const std::string& name = entry["name"].get_ref<const std::string&>();
+            bool valid_name = !name.empty() && name[0] != '.';
+            for (char c : name) {
+                if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.') {
+                    valid_name = false;
+                }
+            }
+            if (!valid_name) {
+                problem = "'name' may only contain letters, digits, '-', '_' and '.'";
+            }
+            for (const auto& repo : repos) {
+                if (repo.name == name) problem = "duplicate repository name";
+            }
+        }
+        
+        if (!problem.empty()) {
+            print_error("Ignoring " + label + " in " + REPOS_CONFIG + ": " + problem);
+            continue;
+        }
+        
+        Repository repo;
+        repo.name = entry["name"].get<std::string>();
+        repo.url = entry["url"].get<std::string>();
+        repo.priority = entry.value("priority", 0);
+        repo.pins = entry.value("pin", std::vector<std::string>());
+        repos.push_back(repo);
+    }
+}
+
+std::string PackageManager::repo_cache_path(const Repository& repo, const std::string& file) {
+    return REPOS_CACHE_DIR + repo.name + "/" + file;
+}
+
+bool PackageManager::fetch_repository(const Repository& repo, bool& changed) {
+    std::string cache_path = repo_cache_path(repo, "repo.json");
+    std::string meta_path = repo_cache_path(repo, "meta.json");
+    changed = false;
     
-    if (!download_file(REPO_URL, CACHE_FILE)) {
+    std::error_code ec;
+    fs::create_directories(REPOS_CACHE_DIR + repo.name, ec);
+    if (ec) {
+        print_error("Failed to create cache directory for repository '" + repo.name + "': " + ec.message());
         return false;
     }
     
+    json meta = json::object();
     try {
-        std::ifstream cache_file(CACHE_FILE);
-        if (!cache_file) {
-            print_error("Failed to read downloaded cache file");
+        std::ifstream meta_file(meta_path);
+        if (meta_file) meta = json::parse(meta_file);
+    } catch (...) {
+        meta = json::object();
+    }
+    if (meta.value("url", "") != repo.url || !fs::exists(cache_path)) {
+        meta = json::object();
+    }
+    
+    json validators = meta.value("validators", json::object());
+    std::string data;
+    bool modified = true;
+    if (!fetch_url(repo.url, data, validators, modified)) {
+        return false;
+    }
+    if (!modified) return true;
+    
+    std::string hash = sha256_hex(data);
+    if (hash != meta.value("sha256", "")) {
+        if (!json::accept(data)) {
+            print_error("Failed to parse repository data for '" + repo.name + "'");
             return false;
         }
-        repo_cache = json::parse(cache_file);
-        print_progress("Updating package cache", 100);
-        print_success("Package cache updated successfully");
+        if (!write_file_atomic(cache_path, data)) return false;
+        changed = true;
+    }
+    
+    json new_meta = {
+        {"url", repo.url},
+        {"sha256", hash},
+        {"validators", validators}
+    };
+    return write_file_atomic(meta_path, new_meta.dump());
+}
+
+bool PackageManager::merge_repositories(const std::vector<Repository>& repos, const std::vector<bool>& changed) {
+    json index = json::object();
+    try {
+        std::ifstream index_file(CACHE_FILE);
+        if (index_file) index = json::parse(index_file);
+    } catch (...) {
+        index = json::object();
+    }
+    
+    json config = json::array();
+    for (const auto& repo : repos) {
+        config.push_back({{"name", repo.name}, {"url", repo.url}, {"priority", repo.priority}, {"pin", repo.pins}});
+    }
+    std::string config_hash = sha256_hex(config.dump());
+    
+    bool full = index.value("config_sha256", "") != config_hash ||
+                !index.contains("repositories") || !index.contains("packages");
+    bool any_changed = false;
+    for (bool c : changed) any_changed = any_changed || c;
+    if (!full && !any_changed) {
+        repo_cache = std::move(index);
         return true;
-    } catch (const std::exception& e) {
-        print_error("Failed to parse repository data: " + std::string(e.what()));
+    }
+    
+    // Unchanged repositories are only parsed if one of their packages has to
+    // be re-resolved, e.g. because a higher priority repository dropped it.
+    std::map<std::string, json> loaded;
+    auto load = [&](const Repository& repo) -> const json& {
+        auto it = loaded.find(repo.name);
+        if (it != loaded.end()) return it->second;
+        
+        json data = json::object();
+        try {
+            std::ifstream repo_file(repo_cache_path(repo, "repo.json"));
+            if (repo_file) data = json::parse(repo_file);
+        } catch (const std::exception& e) {
+            print_error("Failed to read cache for repository '" + repo.name + "': " + e.what());
+        }
+        if (!data.contains("packages") || !data["packages"].is_object()) {
+            data["packages"] = json::object();
+        }
+        return loaded.emplace(repo.name, std::move(data)).first->second;
+    };
+    
+    json repo_entries = full ? json::object() : index["repositories"];
+    std::set<std::string> affected;
+    for (size_t i = 0; i < repos.size(); ++i) {
+        const Repository& repo = repos[i];
+        if (!full && !changed[i]) continue;
+        
+        if (repo_entries.contains(repo.name)) {
+            for (const auto& name : repo_entries[repo.name]["packages"]) {
+                affected.insert(name.get<std::string>());
+            }
+        }
+        
+        json names = json::array();
+        for (const auto& [name, package] : load(repo)["packages"].items()) {
+            names.push_back(name);
+            affected.insert(name);
+        }
+        repo_entries[repo.name] = {
+            {"url", repo.url},
+            {"priority", repo.priority},
+            {"packages", names}
+        };
+    }
+    
+    std::vector<std::set<std::string>> provided(repos.size());
+    for (size_t i = 0; i < repos.size(); ++i) {
+        for (const auto& name : repo_entries[repos[i].name]["packages"]) {
+            provided[i].insert(name.get<std::string>());
+        }
+    }
+    
+    json packages = full ? json::object() : index["packages"];
+    for (const auto& name : affected) {
+        int best = -1;
+        bool best_pinned = false;
+        for (size_t i = 0; i < repos.size(); ++i) {
+            if (!provided[i].count(name)) continue;
+            
+            const auto& pins = repos[i].pins;
+            bool pinned = std::find(pins.begin(), pins.end(), name) != pins.end();
+            if (best < 0 || (pinned && !best_pinned) ||
+                (pinned == best_pinned && repos[i].priority > repos[best].priority)) {
+                best = static_cast<int>(i);
+                best_pinned = pinned;
+            }
+        }
+        
+        if (best < 0) {
+            packages.erase(name);
+            continue;
+        }
+        json package = load(repos[best])["packages"][name];
+        package["repository"] = repos[best].name;
+        packages[name] = package;
+    }
+    
+    index = {
+        {"config_sha256", config_hash},
+        {"repositories", repo_entries},
+        {"packages", packages}
+    };
+    if (!write_file_atomic(CACHE_FILE, index.dump())) return false;
+    repo_cache = std::move(index);
+    return true;
+}
+
+bool PackageManager::cache_repo() {
+    load_repositories();
+    if (repositories.empty()) {
+        print_error("No usable repositories configured in " + std::string(REPOS_CONFIG));
+        return false;
+    }
+    
+    print_progress("Updating package cache", 0);
+    
+    std::vector<char> fetched(repositories.size(), 0);
+    std::vector<char> updated(repositories.size(), 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < repositories.size(); ++i) {
+        threads.emplace_back([this, i, &fetched, &updated]() {
+            bool changed = false;
+            fetched[i] = fetch_repository(repositories[i], changed);
+            updated[i] = changed;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    // A repository that failed and has never been cached is left out of the
+    // merge so one unreachable repository does not block the others.
+    std::vector<Repository> available;
+    std::vector<bool> changed;
+    for (size_t i = 0; i < repositories.size(); ++i) {
+        if (!fetched[i]) {
+            if (!fs::exists(repo_cache_path(repositories[i], "repo.json"))) {
+                print_error("Skipping repository '" + repositories[i].name + "': no cached copy available");
+                continue;
+            }
+            print_error("Using cached copy of repository '" + repositories[i].name + "'");
+        }
+        available.push_back(repositories[i]);
+        changed.push_back(updated[i]);
+    }
+    
+    if (available.empty()) {
+        print_error("No repository could be fetched");
         return false;
     }
+    
+    if (!merge_repositories(available, changed)) {
+        return false;
+    }
+    
+    print_progress("Updating package cache", 100);
+    print_success("Package cache updated successfully");
+    return true;
+}
+
+std::string PackageManager::script_url(const json& package, const std::string& key) {
+    auto script = package.find(key);
+    if (script == package.end() || !script->is_string()) return "";
+    
+    std::string base = repo_url();
+    std::string repo_name = package.value("repository", "");
+    if (repo_cache.contains("repositories") && repo_cache["repositories"].contains(repo_name)) {
+        base = repo_cache["repositories"][repo_name].value("url", base);
+    }
+    return resolve_url(base, script->get<std::string>());
 }
 
 json PackageManager::read_cache() {
@@ -132,26 +656,48 @@ void PackageManager::save_installed_db(const json& db) {
 }
 
 void PackageManager::print_progress(const std::string& message, int percentage) {
+    if (quiet || !stdout_tty) return;
+    
+    std::lock_guard<std::mutex> lock(output_mutex);
+    static std::string last_message;
+    static int last_percentage = -1;
+    if (percentage == last_percentage && message == last_message) return;
+    last_message = message;
+    last_percentage = percentage;
+    
     const int bar_width = 50;
     int filled_width = bar_width * percentage / 100;
     
-    std::cout << BLUE << "\r[";
+    std::string line = BLUE + "\r[";
+    line.reserve(line.size() + bar_width + message.size() + 16);
     for (int i = 0; i < bar_width; ++i) {
-        if (i < filled_width) std::cout << "=";
-        else if (i == filled_width) std::cout << ">";
-        else std::cout << " ";
+        if (i < filled_width) line += '=';
+        else if (i == filled_width) line += '>';
+        else line += ' ';
     }
-    std::cout << "] " << percentage << "% " << message << RESET;
-    std::cout.flush();
-    if (percentage == 100) std::cout << std::endl;
+    line += "] " + std::to_string(percentage) + "% " + message + RESET;
+    if (percentage == 100) line += '\n';
+    std::cout << line << std::flush;
 }
 
 void PackageManager::print_error(const std::string& message) {
-    std::cerr << RED << "Error: " << message << RESET << std::endl;
+    std::lock_guard<std::mutex> lock(output_mutex);
+    if (stderr_tty) {
+        std::cerr << RED << "Error: " << message << RESET << std::endl;
+    } else {
+        std::cerr << "Error: " << message << std::endl;
+    }
 }
 
 void PackageManager::print_success(const std::string& message) {
-    std::cout << GREEN << message << RESET << std::endl;
+    if (quiet) return;
+    
+    std::lock_guard<std::mutex> lock(output_mutex);
+    if (stdout_tty) {
+        std::cout << GREEN << message << RESET << std::endl;
+    } else {
+        std::cout << message << std::endl;
+    }
 }
 
 bool PackageManager::update() {
@@ -159,7 +705,7 @@ bool PackageManager::update() {
 }
 
 bool PackageManager::confirm_action(const std::string& action) {
-    std::cout << YELLOW << "Do you want to " << action << "? [y/N] " << RESET;
+    std::cout << tty_color(YELLOW) << "Do you want to " << action << "? [y/N] " << tty_color(RESET);
     std::string response;
     std::getline(std::cin, response);
     return (response == "y" || response == "Y");
@@ -168,8 +714,6 @@ bool PackageManager::confirm_action(const std::string& action) {
 bool PackageManager::install(const std::string& package_name) {
     if (!update()) return false;
     
-    repo_cache = read_cache();
-    
     if (!repo_cache["packages"].contains(package_name)) {
         print_error("Package '" + package_name + "' not found");
         return false;
@@ -198,7 +742,11 @@ bool PackageManager::install(const std::string& package_name) {
         return false;
     }
     
-    std::string install_script = package["install"];
+    std::string install_script = script_url(package, "install");
+    if (install_script.empty()) {
+        print_error("Package has no install script");
+        return false;
+    }
     std::string temp_script = "/tmp/yns_install_" + package_name + ".sh";
     print_progress("Downloading installation script", 0);
     
@@ -254,7 +802,11 @@ bool PackageManager::remove(const std::string& package_name) {
         return false;
     }
     
-    std::string remove_script = repo_cache["packages"][package_name]["remove"];
+    std::string remove_script = script_url(repo_cache["packages"][package_name], "remove");
+    if (remove_script.empty()) {
+        print_error("Package has no remove script");
+        return false;
+    }
     std::string temp_script = "/tmp/yns_remove_" + package_name + ".sh";
     
     print_progress("Downloading removal script", 0);
@@ -298,7 +850,6 @@ bool PackageManager::upgrade(const std::string& package_name) {
     
     if (!update()) return false;
     
-    repo_cache = read_cache();
     if (!repo_cache["packages"].contains(package_name)) {
         print_error("Package information not found in repository");
         return false;
@@ -312,7 +863,11 @@ bool PackageManager::upgrade(const std::string& package_name) {
         return true;
     }
     
-    std::string update_script = repo_cache["packages"][package_name]["update"];
+    std::string update_script = script_url(repo_cache["packages"][package_name], "update");
+    if (update_script.empty()) {
+        print_error("Package has no update script");
+        return false;
+    }
     std::string temp_script = "/tmp/yns_update_" + package_name + ".sh";
     
     print_progress("Downloading update script", 0);
@@ -345,32 +900,158 @@ bool PackageManager::upgrade(const std::string& package_name) {
     return true;
 }
 
-bool PackageManager::list() {
-    if (!update()) return false;
+bool PackageManager::parse_list_options(const std::vector<std::string>& args, ListOptions& options, std::string& error) {
+    for (const auto& arg : args) {
+        if (arg == "--json") {
+            options.format = ListOptions::Format::Json;
+        } else if (arg == "--tsv") {
+            options.format = ListOptions::Format::Tsv;
+        } else if (arg == "--installed") {
+            options.filter = ListOptions::Filter::Installed;
+        } else if (arg == "--upgradable") {
+            options.filter = ListOptions::Filter::Upgradable;
+        } else if (arg == "--available") {
+            options.filter = ListOptions::Filter::Available;
+        } else if (arg.rfind("--columns=", 0) == 0) {
+            options.columns.clear();
+            std::istringstream columns(arg.substr(10));
+            std::string column;
+            while (std::getline(columns, column, ',')) {
+                if (column != "name" && column != "version" && column != "installed" &&
+                    column != "status" && column != "repository" && column != "description") {
+                    error = "Unknown column '" + column + "'";
+                    return false;
+                }
+                options.columns.push_back(column);
+            }
+        } else {
+            error = "Unknown list option '" + arg + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PackageManager::list(const ListOptions& options) {
+    bool machine_readable = options.format != ListOptions::Format::Text;
+    quiet = machine_readable;
+    bool updated = update();
+    quiet = false;
+    if (!updated) return false;
     
-    repo_cache = read_cache();
+    std::vector<std::string> columns = options.columns;
+    if (columns.empty()) {
+        columns = {"name", "version", "installed", "status"};
+    }
     
-    std::cout << "\nAvailable packages:\n";
-    std::cout << "==================\n";
+    static const json no_packages = json::object();
+    const json& packages = repo_cache.contains("packages") ? repo_cache["packages"] : no_packages;
+    
+    // Scratch space for non-string values, reused across packages.
+    std::string version_text;
+    std::string installed_text;
+    auto as_text = [](const json* value, std::string& scratch) -> std::string_view {
+        if (!value) return {};
+        if (value->is_string()) return value->get_ref<const std::string&>();
+        scratch = value->dump();
+        return scratch;
+    };
+    
+    Output out(stdout);
+    if (options.format == ListOptions::Format::Text) {
+        out.write("\nAvailable packages:\n");
+        out.write("==================\n");
+    } else if (options.format == ListOptions::Format::Json) {
+        out.write('[');
+    }
     
-    for (const auto& [name, package] : repo_cache["packages"].items()) {
-        std::string repo_version = package["version"];
-        std::string status;
+    bool first = true;
+    for (auto it = packages.begin(); it != packages.end(); ++it) {
+        const std::string& name = it.key();
+        const json& package = it.value();
+        auto version_it = package.find("version");
+        const json* version = version_it != package.end() ? &*version_it : nullptr;
+        
+        const json* installed_version = nullptr;
+        auto installed = installed_packages.find(name);
+        bool is_installed = installed != installed_packages.end();
+        if (is_installed) {
+            auto entry = installed->find("version");
+            if (entry != installed->end()) installed_version = &*entry;
+        }
+        
+        bool up_to_date = installed_version && version && *installed_version == *version;
+        const char* status = !is_installed ? "available" : up_to_date ? "installed" : "upgradable";
+        
+        if ((options.filter == ListOptions::Filter::Installed && !is_installed) ||
+            (options.filter == ListOptions::Filter::Upgradable && (!is_installed || up_to_date)) ||
+            (options.filter == ListOptions::Filter::Available && is_installed)) {
+            continue;
+        }
         
-        if (installed_packages.contains(name)) {
-            std::string installed_version = installed_packages[name]["version"];
-            if (installed_version == repo_version) {
-                status = GREEN + "[installed " + installed_version + "]" + RESET;
+        if (options.format == ListOptions::Format::Text) {
+            std::string_view repo_version = as_text(version, version_text);
+            std::string_view current_version = as_text(installed_version, installed_text);
+            out.write(name).write(' ');
+            if (!is_installed) {
+                out.color(BLUE).write("[available ").write(repo_version);
+            } else if (up_to_date) {
+                out.color(GREEN).write("[installed ").write(current_version);
             } else {
-                status = YELLOW + "[installed " + installed_version + ", update available " + repo_version + "]" + RESET;
+                out.color(YELLOW).write("[installed ").write(current_version)
+                   .write(", update available ").write(repo_version);
             }
-        } else {
-            status = BLUE + "[available " + repo_version + "]" + RESET;
+            out.write(']').reset().write('\n');
+            continue;
         }
         
-        std::cout << name << " " << status << "\n";
+        auto field = [&](const std::string& column) -> const json* {
+            if (column == "version") return version;
+            if (column == "installed") return installed_version;
+            auto value = package.find(column);
+            return value != package.end() ? &*value : nullptr;
+        };
+        
+        if (options.format == ListOptions::Format::Json) {
+            out.write(first ? "\n  {" : ",\n  {");
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (i > 0) out.write(", ");
+                out.json_string(columns[i]).write(": ");
+                if (columns[i] == "name") {
+                    out.json_string(name);
+                } else if (columns[i] == "status") {
+                    out.json_string(status);
+                } else if (const json* value = field(columns[i])) {
+                    if (value->is_string()) {
+                        out.json_string(value->get_ref<const std::string&>());
+                    } else {
+                        out.write(value->dump());
+                    }
+                } else {
+                    out.write("null");
+                }
+            }
+            out.write('}');
+        } else {
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (i > 0) out.write('\t');
+                if (columns[i] == "name") {
+                    out.tsv_field(name);
+                } else if (columns[i] == "status") {
+                    out.tsv_field(status);
+                } else {
+                    out.tsv_field(as_text(field(columns[i]), version_text));
+                }
+            }
+            out.write('\n');
+        }
+        first = false;
     }
     
+    if (options.format == ListOptions::Format::Json) {
+        out.write(first ? "]\n" : "\n]\n");
+    }
+    out.flush();
     return true;
 }
 
@@ -381,18 +1062,18 @@ void PackageManager::print_interactive_help() {
               << "  install <package>   Install a package\n"
               << "  remove <package>    Remove a package\n"
               << "  upgrade <package>   Upgrade a package\n"
-              << "  list               List all packages\n"
+              << "  list [options]     List packages (--installed, --upgradable, --json, ...)\n"
               << "  clear              Clear the screen\n"
               << "  exit               Exit interactive mode\n\n";
 }
 
 bool PackageManager::interactive_mode() {
-    std::cout << GREEN << "YNS Package Manager Interactive Mode\n" << RESET;
+    std::cout << tty_color(GREEN) << "YNS Package Manager Interactive Mode\n" << tty_color(RESET);
     std::cout << "Type 'help' for available commands or 'exit' to quit\n";
 
     std::string line;
     while (true) {
-        std::cout << BLUE << "yns> " << RESET;
+        std::cout << tty_color(BLUE) << "yns> " << tty_color(RESET);
         if (!std::getline(std::cin, line) || line == "exit") {
             std::cout << "Goodbye!\n";
             break;
@@ -413,7 +1094,17 @@ bool PackageManager::interactive_mode() {
             update();
         }
         else if (command == "list") {
-            list();
+            std::vector<std::string> args;
+            std::string arg;
+            while (iss >> arg) args.push_back(arg);
+            
+            ListOptions options;
+            std::string error;
+            if (!parse_list_options(args, options, error)) {
+                print_error(error);
+                continue;
+            }
+            list(options);
         }
         else if (command == "clear") {
             system("clear");
@@ -443,7 +1134,13 @@ bool PackageManager::interactive_mode() {
 }
 
 bool PackageManager::debug() {
-    std::cout << "\nRepository URL: " << REPO_URL << "\n";
+    load_repositories();
+    std::cout << "\nRepositories (from " << repositories_source << "):\n";
+    for (const auto& repo : repositories) {
+        std::cout << "  " << repo.name << " " << repo.url << " (priority " << repo.priority;
+        if (!repo.pins.empty()) std::cout << ", " << repo.pins.size() << " pinned";
+        std::cout << ")\n";
+    }
     std::cout << "Cache file: " << CACHE_FILE << "\n";
     std::cout << "Installed DB: " << INSTALLED_DB << "\n\n";
 
@@ -575,4 +1272,173 @@ void PackageManager::updateYns() {
     } catch (const std::exception& e) {
         print_error("Failed to parse update information");
     }
-} 
\ No newline at end of file
+}
+
+bool PackageManager::mirror(const std::string& dir) {
+    struct MirrorJob {
+        std::string url;
+        std::string path;
+        std::string hash;
+        json validators = json::object();
+        bool changed = false;
+        bool ok = false;
+    };
+    
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) {
+        print_error("Failed to create mirror directory " + dir + ": " + ec.message());
+        return false;
+    }
+    
+    if (!update()) return false;
+    
+    json repo = {{"packages", json::object()}};
+    if (repo_cache.contains("packages")) repo["packages"] = repo_cache["packages"];
+    
+    json sources = json::array();
+    for (const auto& source : repositories) {
+        sources.push_back(source.url);
+    }
+    
+    json manifest = json::object();
+    try {
+        std::ifstream manifest_file(fs::path(dir) / MIRROR_MANIFEST);
+        if (manifest_file) manifest = json::parse(manifest_file);
+    } catch (...) {
+        manifest = json::object();
+    }
+    if (!manifest.contains("files") || !manifest["files"].is_object()) {
+        manifest["files"] = json::object();
+    }
+    
+    // Each distinct script URL is stored once under scripts/, named after the
+    // URL's hash, and the mirrored index points at it with a relative path so
+    // the mirror works from file:// or HTTP.
+    std::vector<MirrorJob> jobs;
+    std::map<std::string, size_t> job_by_url;
+    if (repo.contains("packages") && repo["packages"].is_object()) {
+        for (auto& [name, package] : repo["packages"].items()) {
+            for (const char* key : {"install", "remove", "update"}) {
+                if (!package.contains(key) || !package[key].is_string()) continue;
+                
+                std::string url = script_url(package, key);
+                auto existing = job_by_url.find(url);
+                if (existing == job_by_url.end()) {
+                    MirrorJob job;
+                    job.url = url;
+                    job.path = "scripts/" + sha256_hex(url).substr(0, 32) + ".sh";
+                    existing = job_by_url.emplace(url, jobs.size()).first;
+                    jobs.push_back(job);
+                }
+                package[key] = jobs[existing->second].path;
+            }
+            package.erase("repository");
+        }
+    }
+    
+    const json& previous_files = manifest["files"];
+    std::atomic<size_t> next_job{0};
+    std::atomic<size_t> done_jobs{0};
+    auto worker = [&]() {
+        std::string data;
+        for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+            MirrorJob& job = jobs[i];
+            fs::path target = fs::path(dir) / job.path;
+            auto previous = previous_files.find(job.path);
+            bool have_previous = previous != previous_files.end() &&
+                previous->value("url", "") == job.url && fs::exists(target);
+            if (have_previous) {
+                job.validators = previous->value("validators", json::object());
+            }
+            
+            bool modified = true;
+            if (fetch_url(job.url, data, job.validators, modified)) {
+                if (!modified && have_previous) {
+                    job.hash = previous->value("sha256", "");
+                    job.ok = true;
+                } else {
+                    job.hash = sha256_hex(data);
+                    if (have_previous && previous->value("sha256", "") == job.hash) {
+                        job.ok = true;
+                    } else {
+                        std::error_code dir_ec;
+                        fs::create_directories(target.parent_path(), dir_ec);
+                        job.ok = write_file_atomic(target.string(), data);
+                        job.changed = job.ok;
+                    }
+                }
+            }
+            
+            size_t done = ++done_jobs;
+            print_progress("Mirroring scripts", static_cast<int>(done * 99 / jobs.size()));
+        }
+    };
+    
+    if (!jobs.empty()) {
+        size_t thread_count = std::min<size_t>(MIRROR_JOBS, jobs.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    print_progress("Mirroring scripts", 100);
+    
+    size_t failed = 0;
+    size_t changed = 0;
+    json files = json::object();
+    for (const auto& job : jobs) {
+        if (!job.ok) {
+            ++failed;
+            continue;
+        }
+        if (job.changed) ++changed;
+        files[job.path] = {
+            {"url", job.url},
+            {"sha256", job.hash},
+            {"validators", job.validators}
+        };
+    }
+    
+    // Leave the previous index in place so the mirror never references
+    // scripts that failed to sync.
+    if (failed > 0) {
+        print_error("Failed to mirror " + std::to_string(failed) + " of " +
+                    std::to_string(jobs.size()) + " scripts; index not updated");
+        return false;
+    }
+    
+    std::string index_data = repo.dump(4);
+    std::string index_hash = sha256_hex(index_data);
+    fs::path index_path = fs::path(dir) / "repo.json";
+    if (manifest.value("index_sha256", "") != index_hash || !fs::exists(index_path)) {
+        if (!write_file_atomic(index_path.string(), index_data)) return false;
+        ++changed;
+    }
+    
+    json new_manifest = {
+        {"sources", sources},
+        {"index_sha256", index_hash},
+        {"files", files}
+    };
+    if (!write_file_atomic((fs::path(dir) / MIRROR_MANIFEST).string(), new_manifest.dump(4))) {
+        return false;
+    }
+    
+    // Prune only once the new index is in place, so the index being read
+    // never points at a script that has already been removed.
+    size_t removed = 0;
+    for (const auto& [path, entry] : manifest["files"].items()) {
+        if (files.contains(path)) continue;
+        fs::path stale = fs::path(dir) / path;
+        if (fs::remove(stale, ec)) ++removed;
+        if (fs::is_empty(stale.parent_path(), ec)) fs::remove(stale.parent_path(), ec);
+    }
+    
+    print_success("Mirrored " + std::to_string(jobs.size() + 1) + " files to " + dir + " (" +
+                  std::to_string(changed) + " updated, " + std::to_string(removed) + " removed)");
+    return true;
+}